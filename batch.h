@@ -0,0 +1,245 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "keyscheduler.h"
+#include "state.h"
+#include "logger.h"
+
+#define BLOCK_LENGTH 128
+#define MAX_BATCH_WORKERS 1024
+#define MAX_BATCH_MEGABYTES 1048576
+
+// parse a command line count such as "-j 8". only whole numbers from 1 to 'maximum' are accepted
+bool parse_count(const char* text, unsigned int maximum, unsigned int& value) {
+  char* end;
+  errno = 0;
+  long parsed = strtol(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || parsed < 1 || (unsigned long)parsed > maximum) {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+// the outcome of encrypting or decrypting a single file
+struct batchResult {
+  std::string path;
+  bool success;
+  std::string error;
+  size_t bytes;
+};
+
+/* the batchRunner class encrypts or decrypts many files of hexadecimal text under one key.
+the key is expanded once and shared by a fixed pool of workers. a worker only reads a file once
+the bytes already in flight plus the new file fit inside the memory budget. */
+class batchRunner {
+  public:
+    // 'encrypt' picks the direction, output files get a ".enc" or ".dec" suffix
+    batchRunner(std::string key, bool encrypt, unsigned int workers, size_t memory_budget)
+      : keys(key), encrypt(encrypt), workers(workers > 0 ? workers : 1), memory_budget(memory_budget), in_flight(0) {}
+
+    // the suffix appended to every output file
+    std::string suffix() {
+      return encrypt ? ".enc" : ".dec";
+    }
+
+    // list the files to process into 'paths'. 'source' is either a directory or a manifest with one path per line.
+    // returns false if the directory or manifest can't be opened
+    bool collect(std::string source, std::vector<std::string>& paths) {
+      std::vector<std::string> to_return;
+      struct stat info;
+      if (stat(source.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+        DIR* directory = opendir(source.c_str());
+        if (directory == NULL) {
+          return false;
+        }
+        struct dirent* entry;
+        while ((entry = readdir(directory)) != NULL) {
+          std::string path = source + "/" + entry->d_name;
+          // skip sub directories and the output of an earlier run
+          if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode) || endsWith(path, suffix())) {
+            continue;
+          }
+          to_return.push_back(path);
+        }
+        closedir(directory);
+        std::sort(to_return.begin(), to_return.end());
+      } else {
+        std::ifstream manifest(source.c_str());
+        if (!manifest) {
+          return false;
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+          line = strip(line);
+          if (!line.empty()) {
+            to_return.push_back(line);
+          }
+        }
+        if (manifest.bad()) {
+          return false;
+        }
+      }
+      paths = to_return;
+      return true;
+    }
+
+    // process every file on the worker pool. each result is printed as soon as it is done when 'report' is set
+    std::vector<batchResult> run(std::vector<std::string> paths, bool report = true) {
+      // the logger keeps a shared buffer, so it has to stay quiet while the workers are running
+      bool was_verbose = logger::verbose;
+      bool was_suppressed = logger::suppress_output;
+      logger::verbose = false;
+      logger::suppress_output = true;
+
+      std::vector<batchResult> results(paths.size());
+      std::atomic<unsigned int> next_file(0);
+      std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+      std::vector<std::thread> pool;
+      for (unsigned int worker = 0; worker < workers && worker < paths.size(); worker++) {
+        pool.push_back(std::thread([&]() {
+          for (unsigned int index = next_file++; index < paths.size(); index = next_file++) {
+            results[index] = process(paths[index]);
+            if (report) {
+              std::lock_guard<std::mutex> lock(report_mutex);
+              if (results[index].success) {
+                std::cout << results[index].path << "\tok\t" << results[index].bytes << " bytes" << std::endl;
+              } else {
+                std::cout << results[index].path << "\tfailed\t" << results[index].error << std::endl;
+              }
+            }
+          }
+        }));
+      }
+      for (unsigned int worker = 0; worker < pool.size(); worker++) {
+        pool[worker].join();
+      }
+
+      if (report) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        size_t total_bytes = 0;
+        unsigned int failures = 0;
+        for (unsigned int index = 0; index < results.size(); index++) {
+          total_bytes += results[index].bytes;
+          failures += results[index].success ? 0 : 1;
+        }
+        std::cout << results.size() << " files, " << failures << " failed, " << total_bytes << " bytes in "
+          << seconds << " s (" << (seconds > 0 ? total_bytes / seconds / 1000000 : 0) << " MB/s)" << std::endl;
+      }
+
+      logger::verbose = was_verbose;
+      logger::suppress_output = was_suppressed;
+      return results;
+    }
+
+  private:
+    // read, crypt and write a single file while holding its share of the memory budget
+    batchResult process(std::string path) {
+      batchResult result;
+      result.path = path;
+      result.success = false;
+      result.bytes = 0;
+
+      struct stat info;
+      if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        result.error = "could not open file";
+        return result;
+      }
+      // the only large buffers are the input text and the output text, which is never longer than the input
+      size_t reserved = info.st_size * 2;
+      acquire(reserved);
+
+      // read straight into a single string and strip it in place, so no extra copies are held
+      std::string text_in(info.st_size, '\0');
+      std::ifstream file(path.c_str(), std::ios::binary);
+      file.read(&text_in[0], info.st_size);
+      text_in.resize(file.gcount());
+      stripInPlace(text_in);
+
+      if (file.bad() || (size_t)file.gcount() != (size_t)info.st_size) {
+        result.error = "could not read file";
+      } else if (text_in.length()*4 % BLOCK_LENGTH != 0) {
+        result.error = "text must be a multiple of 128 bits";
+      } else if (text_in.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        result.error = "text must be hexadecimal";
+      } else {
+        std::string text_out;
+        text_out.reserve(text_in.length());
+        for (unsigned int index = 0; index < text_in.length(); index += BLOCK_LENGTH/4) {
+          state crypt_state(text_in.substr(index, BLOCK_LENGTH/4));
+          text_out += encrypt ? crypt_state.encrypt(keys) : crypt_state.decrypt(keys);
+        }
+        std::ofstream output((path + suffix()).c_str());
+        output << text_out << std::endl;
+        if (output) {
+          result.success = true;
+          result.bytes = text_in.length() / 2;
+        } else {
+          result.error = "could not write " + path + suffix();
+        }
+      }
+
+      release(reserved);
+      return result;
+    }
+
+    // wait until 'bytes' fit in the memory budget. a file larger than the whole budget runs on its own
+    void acquire(size_t bytes) {
+      std::unique_lock<std::mutex> lock(budget_mutex);
+      budget_available.wait(lock, [&]() { return in_flight == 0 || in_flight + bytes <= memory_budget; });
+      in_flight += bytes;
+    }
+
+    // give 'bytes' back to the memory budget
+    void release(size_t bytes) {
+      std::lock_guard<std::mutex> lock(budget_mutex);
+      in_flight -= bytes;
+      budget_available.notify_all();
+    }
+
+    // remove leading and trailing whitespace without copying the text
+    void stripInPlace(std::string& text) {
+      text.erase(text.find_last_not_of(" \t\r\n") + 1);
+      text.erase(0, text.find_first_not_of(" \t\r\n"));
+    }
+
+    // remove leading and trailing whitespace
+    std::string strip(std::string text) {
+      size_t first = text.find_first_not_of(" \t\r\n");
+      if (first == std::string::npos) {
+        return "";
+      }
+      return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+    }
+
+    bool endsWith(std::string text, std::string ending) {
+      return text.length() >= ending.length() && text.compare(text.length() - ending.length(), ending.length(), ending) == 0;
+    }
+
+    // the key is expanded once and only read by the workers
+    keyScheduler keys;
+    bool encrypt;
+    unsigned int workers;
+
+    // bytes currently held by the workers, guarded by budget_mutex
+    size_t memory_budget;
+    size_t in_flight;
+    std::mutex budget_mutex;
+    std::condition_variable budget_available;
+
+    // keeps the per file report lines from interleaving
+    std::mutex report_mutex;
+};
@@ -0,0 +1,161 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "hexhelpers.h"
+#include "keyscheduler.h"
+#include "state.h"
+#include "keywrap.h"
+#include "reencrypt.h"
+#include "perfcounters.h"
+#include "logger.h"
+
+#define BLOCK_LENGTH 128
+
+// format a counter per unit of work, or "n/a" if the host did not expose it
+std::string per_unit(perfCounters& counters, unsigned int counter, double units) {
+  if (!counters.available(counter)) {
+    return "n/a";
+  }
+  std::stringstream to_return;
+  to_return << std::fixed << std::setprecision(2) << counters.get(counter) / units;
+  return to_return.str();
+}
+
+// instructions per cycle, or "n/a" if either counter is missing
+std::string instructions_per_cycle(perfCounters& counters) {
+  if (!counters.available(COUNTER_CYCLES) || !counters.available(COUNTER_INSTRUCTIONS) || counters.get(COUNTER_CYCLES) == 0) {
+    return "n/a";
+  }
+  std::stringstream to_return;
+  to_return << std::fixed << std::setprecision(2) << (double)counters.get(COUNTER_INSTRUCTIONS) / counters.get(COUNTER_CYCLES);
+  return to_return.str();
+}
+
+// time a piece of work that performs 'blocks' 128 bit block operations and print one row of results
+void run_benchmark(perfCounters& counters, std::string engine, std::string mode, unsigned int key_bits, unsigned int blocks, std::function<void()> work) {
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  counters.start();
+  work();
+  counters.stop();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  double bytes = blocks * BLOCK_LENGTH / 8.0;
+
+  std::cout << std::left << std::setw(12) << engine << std::setw(11) << mode << std::setw(6) << key_bits
+    << std::right << std::fixed << std::setprecision(3) << std::setw(10) << bytes / seconds / 1000000
+    << std::setw(12) << per_unit(counters, COUNTER_CYCLES, bytes)
+    << std::setw(8) << instructions_per_cycle(counters)
+    << std::setw(14) << per_unit(counters, COUNTER_L1D_MISSES, blocks)
+    << std::setw(16) << per_unit(counters, COUNTER_BRANCH_MISSES, blocks) << std::endl;
+}
+
+// benchmark every engine and mode for each key size.
+// usage: aes-bench [-n blocks] [--no-counters]
+int main(int argc, char** argv) {
+  unsigned int blocks = 1000;
+  bool use_counters = true;
+  for (signed int index = 1; index < argc; index++) {
+    std::string arg = std::string(argv[index]);
+    if (arg == "-n" && index + 1 < argc) {
+      blocks = atoi(argv[++index]);
+    } else if (arg == "--no-counters") {
+      use_counters = false;
+    }
+  }
+  // the key wrap benchmarks need at least 256 bits of text to wrap
+  if (blocks < 2) {
+    blocks = 2;
+  }
+
+  // with verbose off, the state and the key schedule skip formatting their debug output,
+  // so every engine is timed without logging overhead
+  logger::verbose = false;
+  logger::suppress_output = true;
+
+  perfCounters counters(use_counters);
+  if (use_counters && !counters.opened(COUNTER_CYCLES)) {
+    std::cout << "hardware counters unavailable (check /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+  }
+  std::cout << std::left << std::setw(12) << "engine" << std::setw(11) << "mode" << std::setw(6) << "bits"
+    << std::right << std::setw(10) << "MB/s" << std::setw(12) << "cycles/byte" << std::setw(8) << "IPC"
+    << std::setw(14) << "L1D miss/blk" << std::setw(16) << "branch miss/blk" << std::endl;
+
+  std::mt19937 generator(465);
+  std::string text = random_hex(generator, blocks * BLOCK_LENGTH/4);
+  unsigned int key_sizes[] = { 128, 192, 256 };
+  for (unsigned int size = 0; size < 3; size++) {
+    unsigned int key_bits = key_sizes[size];
+    std::string key = random_hex(generator, key_bits/4);
+    std::string new_key = random_hex(generator, key_bits/4);
+    // every engine's key schedules are expanded before its timing starts
+    keyScheduler keys(key);
+    keyScheduler new_keys(new_key);
+    reEncryptor rotator(key, new_key);
+
+    // the original cli path: the key is expanded again for every block
+    run_benchmark(counters, "per-block", "encrypt", key_bits, blocks, [&]() {
+      for (unsigned int index = 0; index < text.length(); index += BLOCK_LENGTH/4) {
+        state crypt_state(text.substr(index, BLOCK_LENGTH/4));
+        crypt_state.encrypt(key);
+      }
+    });
+    run_benchmark(counters, "per-block", "decrypt", key_bits, blocks, [&]() {
+      for (unsigned int index = 0; index < text.length(); index += BLOCK_LENGTH/4) {
+        state crypt_state(text.substr(index, BLOCK_LENGTH/4));
+        crypt_state.decrypt(key);
+      }
+    });
+    run_benchmark(counters, "per-block", "reencrypt", key_bits, blocks * 2, [&]() {
+      for (unsigned int index = 0; index < text.length(); index += BLOCK_LENGTH/4) {
+        state old_state(text.substr(index, BLOCK_LENGTH/4));
+        state new_state(old_state.decrypt(key));
+        new_state.encrypt(new_key);
+      }
+    });
+
+    // the key schedule is expanded once and reused
+    run_benchmark(counters, "scheduled", "encrypt", key_bits, blocks, [&]() {
+      for (unsigned int index = 0; index < text.length(); index += BLOCK_LENGTH/4) {
+        state crypt_state(text.substr(index, BLOCK_LENGTH/4));
+        crypt_state.encrypt(keys);
+      }
+    });
+    run_benchmark(counters, "scheduled", "decrypt", key_bits, blocks, [&]() {
+      for (unsigned int index = 0; index < text.length(); index += BLOCK_LENGTH/4) {
+        state crypt_state(text.substr(index, BLOCK_LENGTH/4));
+        crypt_state.decrypt(keys);
+      }
+    });
+    run_benchmark(counters, "scheduled", "reencrypt", key_bits, blocks * 2, [&]() {
+      for (unsigned int index = 0; index < text.length(); index += BLOCK_LENGTH/4) {
+        state old_state(text.substr(index, BLOCK_LENGTH/4));
+        state new_state(old_state.decrypt(keys));
+        new_state.encrypt(new_keys);
+      }
+    });
+
+    // several blocks go through each round together
+    run_benchmark(counters, "batched", "reencrypt", key_bits, blocks * 2, [&]() {
+      rotator.reencrypt(text);
+    });
+
+    // wrapping a 256 bit key takes 4 semiblocks * 6 steps = 24 block operations
+    keyWrapper wrapper(key);
+    std::string wrapped = wrapper.wrap(text.substr(0, 256/4));
+    unsigned int total_wraps = blocks / 24 + 1;
+    run_benchmark(counters, "scheduled", "wrap", key_bits, total_wraps * 24, [&]() {
+      for (unsigned int index = 0; index < total_wraps; index++) {
+        wrapper.wrap(text.substr(0, 256/4));
+      }
+    });
+    run_benchmark(counters, "scheduled", "unwrap", key_bits, total_wraps * 24, [&]() {
+      for (unsigned int index = 0; index < total_wraps; index++) {
+        wrapper.unwrap(wrapped);
+      }
+    });
+  }
+  return 0;
+}
@@ -1,5 +1,7 @@
 #pragma once
 #include <sstream>
+#include <vector>
+#include <random>
 #include <math.h>
 #define UPPER_BITS_MASK 0xf0
 #define LOWER_BITS_MASK 0x0f
@@ -70,3 +72,31 @@ std::string half_byte_to_hex(uint8_t num) {
 std::string byte_to_hex(uint8_t num) {
   return half_byte_to_hex(num >> 4) + half_byte_to_hex(num & LOWER_BITS_MASK);
 }
+
+// convert a string of hex digits into a vector of bytes, two digits per byte
+std::vector<uint8_t> hex_to_bytes(std::string hex) {
+  std::vector<uint8_t> to_return(hex.length() / 2);
+  for (unsigned int index = 0; index < to_return.size(); index++) {
+    to_return[index] = hex_char_to_int(hex[index*2]) << 4 | hex_char_to_int(hex[index*2 + 1]);
+  }
+  return to_return;
+}
+
+// convert a vector of bytes into a string of hex digits
+std::string bytes_to_hex(std::vector<uint8_t> bytes) {
+  std::string to_return;
+  for (unsigned int index = 0; index < bytes.size(); index++) {
+    to_return += byte_to_hex(bytes[index]);
+  }
+  return to_return;
+}
+
+// generate a random string of hexadecimal digits
+std::string random_hex(std::mt19937& generator, unsigned int digits) {
+  std::uniform_int_distribution<int> distribution(0, 15);
+  std::string to_return;
+  for (unsigned int index = 0; index < digits; index++) {
+    to_return += half_byte_to_hex(distribution(generator));
+  }
+  return to_return;
+}
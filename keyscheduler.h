@@ -112,12 +112,20 @@ class keyScheduler {
     // get a key using the passed in index
     std::vector<std::vector<uint8_t> > get(unsigned int key_index, unsigned int round_index = NO_ROUND_SPECIFIED) {
       std::vector<std::vector<uint8_t> > to_return(4, vector<uint8_t>(4, 0));
-      stringstream debug_string;
       // convert the coloumns of rows to rows of columns
       for (unsigned int column = key_index*4; column < key_index*4+4 && column < columns.size(); column++) {
         for (unsigned int row = 0; row < columns[column].size(); row++) {
           to_return[row][column - key_index*4] = columns[column][row];
-          debug_string << byte_to_hex(to_return[row][column - key_index*4]);
+        }
+      }
+      // the key is only formatted for the debug log when verbose logging is on
+      if (!logger::verbose) {
+        return to_return;
+      }
+      stringstream debug_string;
+      for (unsigned int column = key_index*4; column < key_index*4+4 && column < columns.size(); column++) {
+        for (unsigned int row = 0; row < columns[column].size(); row++) {
+          debug_string << byte_to_hex(columns[column][row]);
         }
       }
       // an optional 'round_index' argument can be passed in. this is printed in the debug
@@ -130,6 +138,11 @@ class keyScheduler {
       return to_return;
     }
 
+    // the number of rounds this schedule was expanded for (10, 12 or 14)
+    unsigned int rounds() {
+      return columns.size()/4 - 1;
+    }
+
     // dump the entire keyscheduler
     std::string to_string() {
       stringstream to_return;
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <sstream>
+#include "hexhelpers.h"
+#include "keyscheduler.h"
+#include "state.h"
+
+#define SEMIBLOCK_LENGTH 64
+#define WRAP_STEPS 6
+
+/* the keyWrapper class implements the AES key wrap algorithm (RFC 3394).
+the key encryption key is expanded once and reused for every block operation */
+class keyWrapper {
+  public:
+    // the key encryption key is a string of hexadecimal digits 128, 192 or 256 bits long
+    keyWrapper(std::string kek) : keys(kek) {}
+
+    // wrap a key (or any data) that is a multiple of 64 bits and at least 128 bits long.
+    // the result is 64 bits longer than the input
+    std::string wrap(std::string plain_key) {
+      unsigned int total_semiblocks = plain_key.length()*4/SEMIBLOCK_LENGTH;
+      if (plain_key.length()*4 % SEMIBLOCK_LENGTH != 0 || total_semiblocks < 2) {
+        throw;
+      }
+      std::vector<std::vector<uint8_t> > registers = split(plain_key, total_semiblocks);
+      std::vector<uint8_t> integrity(initial_value, initial_value + 8);
+
+      for (unsigned int step = 0; step < WRAP_STEPS; step++) {
+        for (unsigned int index = 0; index < total_semiblocks; index++) {
+          state crypt_state(bytes_to_hex(integrity) + bytes_to_hex(registers[index]));
+          std::vector<uint8_t> block = hex_to_bytes(crypt_state.encrypt(keys));
+          integrity = std::vector<uint8_t>(block.begin(), block.begin() + 8);
+          registers[index] = std::vector<uint8_t>(block.begin() + 8, block.end());
+          xorCounter(integrity, total_semiblocks*step + index + 1);
+        }
+      }
+
+      std::string to_return = bytes_to_hex(integrity);
+      for (unsigned int index = 0; index < total_semiblocks; index++) {
+        to_return += bytes_to_hex(registers[index]);
+      }
+      return to_return;
+    }
+
+    // reverse the wrap operation. if the integrity check fails, an empty string is returned
+    std::string unwrap(std::string wrapped_key) {
+      unsigned int total_semiblocks = wrapped_key.length()*4/SEMIBLOCK_LENGTH;
+      if (wrapped_key.length()*4 % SEMIBLOCK_LENGTH != 0 || total_semiblocks < 3) {
+        throw;
+      }
+      total_semiblocks--;
+      std::vector<uint8_t> integrity = hex_to_bytes(wrapped_key.substr(0, SEMIBLOCK_LENGTH/4));
+      std::vector<std::vector<uint8_t> > registers = split(wrapped_key.substr(SEMIBLOCK_LENGTH/4), total_semiblocks);
+
+      for (unsigned int step = WRAP_STEPS; step > 0; step--) {
+        for (unsigned int index = total_semiblocks; index > 0; index--) {
+          xorCounter(integrity, total_semiblocks*(step - 1) + index);
+          state crypt_state(bytes_to_hex(integrity) + bytes_to_hex(registers[index - 1]));
+          std::vector<uint8_t> block = hex_to_bytes(crypt_state.decrypt(keys));
+          integrity = std::vector<uint8_t>(block.begin(), block.begin() + 8);
+          registers[index - 1] = std::vector<uint8_t>(block.begin() + 8, block.end());
+        }
+      }
+
+      // look at every byte before deciding, so the time taken doesn't reveal where the mismatch is
+      uint8_t difference = 0;
+      for (unsigned int index = 0; index < 8; index++) {
+        difference |= integrity[index] ^ initial_value[index];
+      }
+      if (difference != 0) {
+        return "";
+      }
+      std::string to_return;
+      for (unsigned int index = 0; index < total_semiblocks; index++) {
+        to_return += bytes_to_hex(registers[index]);
+      }
+      return to_return;
+    }
+
+  private:
+    // split a string of hex digits into 64 bit registers
+    std::vector<std::vector<uint8_t> > split(std::string text, unsigned int total_semiblocks) {
+      std::vector<std::vector<uint8_t> > to_return(total_semiblocks);
+      for (unsigned int index = 0; index < total_semiblocks; index++) {
+        to_return[index] = hex_to_bytes(text.substr(index*SEMIBLOCK_LENGTH/4, SEMIBLOCK_LENGTH/4));
+      }
+      return to_return;
+    }
+
+    // xor the step counter 't' into the integrity register, most significant byte first
+    void xorCounter(std::vector<uint8_t>& integrity, uint64_t counter) {
+      for (unsigned int index = 8; index > 0 && counter > 0; index--) {
+        integrity[index - 1] ^= counter & 0xff;
+        counter >>= 8;
+      }
+    }
+
+    // the key encryption key, expanded once in the constructor
+    keyScheduler keys;
+
+    // the default initial value from RFC 3394 section 2.2.3.1
+    const uint8_t initial_value[8] = { 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6, 0xa6 };
+};
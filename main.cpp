@@ -1,7 +1,12 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <thread>
 #include "state.h"
+#include "keyscheduler.h"
+#include "keywrap.h"
+#include "reencrypt.h"
+#include "batch.h"
 #include "logger.h"
 
 #define BLOCK_LENGTH 128
@@ -12,45 +17,104 @@ int main(int argc, char** argv) {
   if (argc >= 1) {
     std::string arg1 = std::string(argv[1]);
     if (arg1 == "help" || arg1 == "--help") {
-      std::cout << "aes [-v] [encrypt|decrypt] [text] [key]" << std::endl;
+      std::cout << "aes [-v] [encrypt|decrypt|wrap|unwrap] [text] [key]" << std::endl;
+      std::cout << "aes [-v] reencrypt [text] [old key] [new key]" << std::endl;
+      std::cout << "aes batch [encrypt|decrypt] [manifest|directory] [key] [-j workers] [-m megabytes]" << std::endl;
       return 0;
     }
   }
 
   // allow printing all the steps of the cypher when "-v" is passed in
+  // "-j" and "-m" bound the worker pool and the memory in flight for batch mode
   std::vector<std::string> args;
   logger::verbose = false;
+  unsigned int workers = std::thread::hardware_concurrency();
+  unsigned int budget_megabytes = 256;
   for (signed int index = 1; index < argc; index++) {
     if (std::string(argv[index]) == "-v") {
       logger::verbose = true;
+    } else if (std::string(argv[index]) == "-j") {
+      if (index + 1 >= argc || !parse_count(argv[++index], MAX_BATCH_WORKERS, workers)) {
+        std::cout << "wrong arguments: -j must be a whole number from 1 to " << MAX_BATCH_WORKERS << std::endl;
+        return 1;
+      }
+    } else if (std::string(argv[index]) == "-m") {
+      if (index + 1 >= argc || !parse_count(argv[++index], MAX_BATCH_MEGABYTES, budget_megabytes)) {
+        std::cout << "wrong arguments: -m must be a whole number from 1 to " << MAX_BATCH_MEGABYTES << std::endl;
+        return 1;
+      }
     } else {
       args.push_back(std::string(argv[index]));
     }
   }
 
-  if (args.size() != 3) {
+  if (args.size() == 4 && (args[0] == "reencrypt" || args[0] == "-reencrypt")) {
+    // decrypt under the old key and encrypt under the new key in one pass
+    reEncryptor rotator(args[2], args[3]);
+    std::cout << rotator.reencrypt(args[1]) << std::endl;
+    return 0;
+  } else if (args.size() == 4 && (args[0] == "batch" || args[0] == "-batch")) {
+    // encrypt or decrypt every file in a manifest or directory under one key
+    std::string operation = args[1].substr(0, 1) == "-" ? args[1].substr(1, 1) : args[1].substr(0, 1);
+    if (operation != "e" && operation != "d") {
+      std::cout << "invalid operation, must be either 'encrypt' or 'decrypt'" << std::endl;
+      return 1;
+    }
+    batchRunner runner(args[3], operation == "e", workers, (size_t)budget_megabytes * 1024 * 1024);
+    std::vector<std::string> paths;
+    if (!runner.collect(args[2], paths)) {
+      std::cout << "could not read manifest or directory '" << args[2] << "'" << std::endl;
+      return 1;
+    }
+    std::vector<batchResult> results = runner.run(paths);
+    for (unsigned int index = 0; index < results.size(); index++) {
+      if (!results[index].success) {
+        return 1;
+      }
+    }
+    return 0;
+  } else if (args.size() != 3) {
     std::cout << "wrong number of arguments" << std::endl;
   } else {
 
+    std::string text_in = std::string(args[1]);
+    std::string key = std::string(args[2]);
+
+    // key wrapping works on 64 bit semiblocks rather than 128 bit blocks
+    if (args[0] == "wrap" || args[0] == "-wrap") {
+      keyWrapper wrapper(key);
+      std::cout << wrapper.wrap(text_in) << std::endl;
+      return 0;
+    } else if (args[0] == "unwrap" || args[0] == "-unwrap") {
+      keyWrapper wrapper(key);
+      std::string unwrapped = wrapper.unwrap(text_in);
+      if (unwrapped.empty()) {
+        std::cout << "integrity check failed" << std::endl;
+        return 1;
+      }
+      std::cout << unwrapped << std::endl;
+      return 0;
+    }
+
     // format the operation to be either "e" for encrypt or "d" for decrypt
     if (args[0].substr(0, 1) == "-") {
       args[0] = args[0].substr(1, args[0].length() - 1);
     }
     args[0] = args[0].substr(0, 1);
 
-    std::string text_in = std::string(args[1]);
-    std::string key = std::string(args[2]);
+    // expand the key once and reuse it for every block
+    keyScheduler keys(key);
 
     std::stringstream text_out;
     //split the passed in text into blocks of 128 bits
     for (unsigned int index = 0; index < text_in.length(); index += BLOCK_LENGTH/4) {
-      state crypt_state(text_in.substr(0, BLOCK_LENGTH / 4));
+      state crypt_state(text_in.substr(index, BLOCK_LENGTH / 4));
       if (args[0] == "e") {
         // start encrypting the plain text
-        text_out << crypt_state.encrypt(key);
+        text_out << crypt_state.encrypt(keys);
       } else if (args[0] == "d") {
         // start decrypting the cypher text
-        text_out << crypt_state.decrypt(key);
+        text_out << crypt_state.decrypt(keys);
       } else {
         std::cout << "invalid operation, must be either 'encrypt' or 'decrypt'" << std::endl;
       }
@@ -0,0 +1,131 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+#define COUNTER_CYCLES 0
+#define COUNTER_INSTRUCTIONS 1
+#define COUNTER_L1D_MISSES 2
+#define COUNTER_BRANCH_MISSES 3
+#define TOTAL_COUNTERS 4
+
+/* the perfCounters class reads hardware counters for the calling thread through perf_event_open.
+the cycles counter leads a group that the other counters join, so the kernel always schedules them together.
+a counter the host does not expose is simply reported as unavailable */
+class perfCounters {
+  public:
+    perfCounters(bool enabled = true) : descriptors(TOTAL_COUNTERS, -1), values(TOTAL_COUNTERS, 0), valid(TOTAL_COUNTERS, false) {
+#ifdef __linux__
+      if (!enabled) {
+        return;
+      }
+      // if cycles can't be opened the other counters fall back to running on their own
+      descriptors[COUNTER_CYCLES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+      int leader = descriptors[COUNTER_CYCLES];
+      descriptors[COUNTER_INSTRUCTIONS] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+      descriptors[COUNTER_L1D_MISSES] = open(PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), leader);
+      descriptors[COUNTER_BRANCH_MISSES] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader);
+#endif
+    }
+
+    ~perfCounters() {
+#ifdef __linux__
+      for (unsigned int counter = 0; counter < TOTAL_COUNTERS; counter++) {
+        if (descriptors[counter] >= 0) {
+          close(descriptors[counter]);
+        }
+      }
+#endif
+    }
+
+    // zero and start every available counter
+    void start() {
+#ifdef __linux__
+      control(PERF_EVENT_IOC_RESET);
+      control(PERF_EVENT_IOC_ENABLE);
+#endif
+    }
+
+    // stop every available counter and remember its value.
+    // if the kernel had to multiplex the counters, the value is scaled up by time enabled / time running
+    void stop() {
+#ifdef __linux__
+      control(PERF_EVENT_IOC_DISABLE);
+      for (unsigned int counter = 0; counter < TOTAL_COUNTERS; counter++) {
+        values[counter] = 0;
+        valid[counter] = false;
+        if (descriptors[counter] < 0) {
+          continue;
+        }
+        // value, time enabled, time running
+        uint64_t reading[3];
+        if (::read(descriptors[counter], reading, sizeof(reading)) != sizeof(reading) || reading[2] == 0) {
+          continue;
+        }
+        values[counter] = reading[2] == reading[1] ? reading[0] : (uint64_t)((double)reading[0] * reading[1] / reading[2]);
+        valid[counter] = true;
+      }
+#endif
+    }
+
+    // whether the counter was opened and actually counted during the last start/stop pair
+    bool available(unsigned int counter) {
+      return descriptors[counter] >= 0 && valid[counter];
+    }
+
+    // whether the host let us open a counter at all
+    bool opened(unsigned int counter) {
+      return descriptors[counter] >= 0;
+    }
+
+    // the value of a counter from the last start/stop pair
+    uint64_t get(unsigned int counter) {
+      return values[counter];
+    }
+
+  private:
+#ifdef __linux__
+    // apply an ioctl to every counter. a group leader passes it on to its whole group
+    void control(unsigned long request) {
+      for (unsigned int counter = 0; counter < TOTAL_COUNTERS; counter++) {
+        if (descriptors[counter] < 0) {
+          continue;
+        }
+        if (counter == COUNTER_CYCLES) {
+          ioctl(descriptors[counter], request, PERF_IOC_FLAG_GROUP);
+        } else if (descriptors[COUNTER_CYCLES] < 0) {
+          ioctl(descriptors[counter], request, 0);
+        }
+      }
+    }
+
+    // open a single counter for this thread, user space only.
+    // a group leader ('group' of -1) starts disabled, members follow the leader
+    int open(uint32_t type, uint64_t config, int group) {
+      struct perf_event_attr attributes;
+      memset(&attributes, 0, sizeof(attributes));
+      attributes.size = sizeof(attributes);
+      attributes.type = type;
+      attributes.config = config;
+      attributes.disabled = group < 0 ? 1 : 0;
+      attributes.exclude_kernel = 1;
+      attributes.exclude_hv = 1;
+      attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      return syscall(__NR_perf_event_open, &attributes, 0, -1, group, 0);
+    }
+#endif
+
+    // one file descriptor per counter, -1 if it could not be opened
+    std::vector<int> descriptors;
+    std::vector<uint64_t> values;
+    // false when the last read failed or the counter never got scheduled
+    std::vector<bool> valid;
+};
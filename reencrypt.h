@@ -0,0 +1,112 @@
+#pragma once
+#include <vector>
+#include <sstream>
+#include "keyscheduler.h"
+#include "state.h"
+
+#define BLOCK_LENGTH 128
+#define BLOCKS_IN_FLIGHT 8
+
+/* the reEncryptor class rotates cypher text from one key to another.
+both key schedules are expanded once, and each buffer is decrypted under the old key
+and encrypted under the new key in a single pass. */
+class reEncryptor {
+  public:
+    // both keys are strings of hexadecimal digits 128, 192 or 256 bits long
+    reEncryptor(std::string old_key, std::string new_key) : old_keys(old_key), new_keys(new_key) {}
+
+    // re-encrypt a string of hexadecimal digits that is a multiple of 128 bits
+    std::string reencrypt(std::string text_in) {
+      if (text_in.length()*4 % BLOCK_LENGTH != 0) {
+        throw;
+      }
+      std::stringstream text_out;
+      // work on several blocks at a time so that each round key is fetched once per batch
+      for (unsigned int index = 0; index < text_in.length(); index += BLOCKS_IN_FLIGHT*BLOCK_LENGTH/4) {
+        std::vector<state> in_flight;
+        for (unsigned int block = index; block < index + BLOCKS_IN_FLIGHT*BLOCK_LENGTH/4 && block < text_in.length(); block += BLOCK_LENGTH/4) {
+          in_flight.push_back(state(text_in.substr(block, BLOCK_LENGTH/4)));
+        }
+        // with verbose logging on, the steps of the very first block are traced like state::decrypt and state::encrypt
+        decrypt(in_flight, index == 0);
+        encrypt(in_flight, index == 0);
+        for (unsigned int block = 0; block < in_flight.size(); block++) {
+          text_out << in_flight[block].to_string();
+        }
+      }
+      return text_out.str();
+    }
+
+  private:
+    // same steps as state::decrypt, but every state in the batch goes through a round together
+    void decrypt(std::vector<state>& in_flight, bool trace) {
+      unsigned int total_rounds = old_keys.rounds();
+      debug(in_flight, trace, 0, "input\t");
+      addRoundKey(in_flight, old_keys.get(total_rounds, 0));
+      for (unsigned int round_index = 1; round_index < total_rounds; round_index++) {
+        std::vector<std::vector<uint8_t> > round_key = old_keys.get(total_rounds - round_index, round_index);
+        debug(in_flight, trace, round_index, "start\t");
+        for (unsigned int block = 0; block < in_flight.size(); block++) {
+          in_flight[block].invShiftRows();
+          debug(in_flight, trace && block == 0, round_index, "invShiftRows");
+          in_flight[block].invSubBytes();
+          debug(in_flight, trace && block == 0, round_index, "invSubBytes");
+          in_flight[block].addRoundKey(round_key);
+          debug(in_flight, trace && block == 0, round_index, "addRoundKey");
+          in_flight[block].invMixColumns();
+        }
+      }
+      for (unsigned int block = 0; block < in_flight.size(); block++) {
+        in_flight[block].invShiftRows();
+        debug(in_flight, trace && block == 0, total_rounds, "invShiftRows");
+        in_flight[block].invSubBytes();
+        debug(in_flight, trace && block == 0, total_rounds, "invSubBytes");
+      }
+      addRoundKey(in_flight, old_keys.get(0, total_rounds));
+    }
+
+    // same steps as state::encrypt, but every state in the batch goes through a round together
+    void encrypt(std::vector<state>& in_flight, bool trace) {
+      unsigned int total_rounds = new_keys.rounds();
+      debug(in_flight, trace, 0, "input\t");
+      addRoundKey(in_flight, new_keys.get(0));
+      for (unsigned int round_index = 1; round_index < total_rounds; round_index++) {
+        std::vector<std::vector<uint8_t> > round_key = new_keys.get(round_index);
+        debug(in_flight, trace, round_index, "start\t");
+        for (unsigned int block = 0; block < in_flight.size(); block++) {
+          in_flight[block].subBytes();
+          debug(in_flight, trace && block == 0, round_index, "subBytes");
+          in_flight[block].shiftRows();
+          debug(in_flight, trace && block == 0, round_index, "shiftRows");
+          in_flight[block].mixColumns();
+          debug(in_flight, trace && block == 0, round_index, "mixColumns");
+          in_flight[block].addRoundKey(round_key);
+        }
+      }
+      for (unsigned int block = 0; block < in_flight.size(); block++) {
+        in_flight[block].subBytes();
+        debug(in_flight, trace && block == 0, total_rounds, "subBytes");
+        in_flight[block].shiftRows();
+        debug(in_flight, trace && block == 0, total_rounds, "shiftRows");
+      }
+      addRoundKey(in_flight, new_keys.get(total_rounds));
+    }
+
+    // log a step of the first block in the batch
+    void debug(std::vector<state>& in_flight, bool trace, unsigned int round, std::string step) {
+      if (trace) {
+        in_flight[0].debug(round, step);
+      }
+    }
+
+    // add the same round key to every state in the batch
+    void addRoundKey(std::vector<state>& in_flight, std::vector<std::vector<uint8_t> > round_key) {
+      for (unsigned int block = 0; block < in_flight.size(); block++) {
+        in_flight[block].addRoundKey(round_key);
+      }
+    }
+
+    // the old and new key schedules, expanded once in the constructor
+    keyScheduler old_keys;
+    keyScheduler new_keys;
+};
@@ -31,30 +31,32 @@ class state {
     // use a key to encrypt the block passed in the constructor
     // the key is a string of hexadecimal digits
     std::string encrypt(std::string key) {
-      logger log;
-
       keyScheduler keys(key);
+      return encrypt(keys);
+    }
 
-      log.debug(0, "input\t", to_string());
-      unsigned int total_rounds = numRounds(key);
+    // same as above, but reuse a key schedule that has already been expanded
+    std::string encrypt(keyScheduler& keys) {
+      debug(0, "input\t");
+      unsigned int total_rounds = keys.rounds();
       addRoundKey(keys.get(0));
 
       // go through each round except the final round
       for (unsigned int round_index = 1; round_index < total_rounds; round_index++) {
-        log.debug(round_index, "start\t", to_string());
+        debug(round_index, "start\t");
         subBytes();
-        log.debug(round_index, "subBytes", to_string());
+        debug(round_index, "subBytes");
         shiftRows();
-        log.debug(round_index, "shiftRows", to_string());
+        debug(round_index, "shiftRows");
         mixColumns();
-        log.debug(round_index, "mixColumns", to_string());
+        debug(round_index, "mixColumns");
         addRoundKey(keys.get(round_index));
       }
       // the final round doesn't include mixColumns step
       subBytes();
-      log.debug(total_rounds, "subBytes", to_string());
+      debug(total_rounds, "subBytes");
       shiftRows();
-      log.debug(total_rounds, "shiftRows", to_string());
+      debug(total_rounds, "shiftRows");
       addRoundKey(keys.get(total_rounds));
       return to_string();
     }
@@ -62,29 +64,31 @@ class state {
     // use a key to decrypt the block passed in the constructor
     // the key is a string of hexadecimal digits
     std::string decrypt(std::string key) {
-      logger log;
-
       keyScheduler keys(key);
+      return decrypt(keys);
+    }
 
-      log.debug(0, "input\t", to_string());
-      unsigned int total_rounds = numRounds(key);
+    // same as above, but reuse a key schedule that has already been expanded
+    std::string decrypt(keyScheduler& keys) {
+      debug(0, "input\t");
+      unsigned int total_rounds = keys.rounds();
       addRoundKey(keys.get(total_rounds, 0));
 
       // go through each round except the final round
       for (unsigned int round_index = 1; round_index < total_rounds; round_index++) {
-        log.debug(round_index, "start\t", to_string());
+        debug(round_index, "start\t");
         invShiftRows();
-        log.debug(round_index, "invShiftRows", to_string());
+        debug(round_index, "invShiftRows");
         invSubBytes();
-        log.debug(round_index, "invSubBytes", to_string());
+        debug(round_index, "invSubBytes");
         addRoundKey(keys.get(total_rounds - round_index, round_index));
-        log.debug(round_index, "addRoundKey", to_string());
+        debug(round_index, "addRoundKey");
         invMixColumns();
       }
       invShiftRows();
-      log.debug(total_rounds, "invShiftRows", to_string());
+      debug(total_rounds, "invShiftRows");
       invSubBytes();
-      log.debug(total_rounds, "invSubBytes", to_string());
+      debug(total_rounds, "invSubBytes");
       addRoundKey(keys.get(0, total_rounds));
       return to_string();
     }
@@ -196,21 +200,14 @@ class state {
       }
       return output.str();
     }
-  private:
-    // given the key size, return the number of rounds to perform
-    unsigned int numRounds(std::string key) {
-      unsigned int key_length = key.length()*4;
-      if (key_length == 128) {
-        return 10;
-      } else if (key_length == 192) {
-        return 12;
-      } else if (key_length == 256) {
-        return 14;
-      } else {
-        throw;
+    // log the state after a step. the state is only formatted when verbose logging is on
+    void debug(unsigned int round, std::string step) {
+      if (logger::verbose) {
+        logger log;
+        log.debug(round, step, to_string());
       }
     }
-
+  private:
     // finite field multiply used in mixColumns
     uint8_t ffMult(uint8_t a, uint8_t b) {
       return shift(a, b, 0) ^ shift(a, b, 1) ^ shift(a, b, 2) ^ shift(a, b, 3) ^ shift(a, b, 4) ^ shift(a, b, 5) ^ shift(a, b, 6) ^ shift(a, b, 7);
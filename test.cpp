@@ -1,5 +1,14 @@
 #include <iostream>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <vector>
+#include <unistd.h>
+#include "hexhelpers.h"
 #include "state.h"
+#include "keywrap.h"
+#include "reencrypt.h"
+#include "batch.h"
 #include "logger.h"
 
 // compare an expected result against the actual result. display the status (successful|failed) of the test.
@@ -17,10 +26,183 @@ void single_test(std::string test_name, std::string expected_result, std::string
   }
 }
 
+// run a comparison many times and display the status of the whole run on one line.
+// 'compare' fills in the expected and actual result for the iteration it is given.
+void repeated_test(std::string test_name, unsigned int iterations, std::function<void(unsigned int, std::string&, std::string&)> compare) {
+  logger log;
+  std::cout << "testing " << test_name << " (" << iterations << " iterations)";
+  for (unsigned int iteration = 0; iteration < iterations; iteration++) {
+    std::string expected_result;
+    std::string actual_result;
+    compare(iteration, expected_result, actual_result);
+    if (expected_result != actual_result) {
+      std::cout << " failed at iteration " << iteration << std::endl;
+      std::cout << "expected " << expected_result << std::endl << "actual   " << actual_result << std::endl;
+      log.dump_buffer(true);
+      throw;
+    }
+    log.clear_buffer();
+  }
+  std::cout << " successful" << std::endl;
+}
+
+// a single record from a NIST AESAVS response (.rsp) file
+struct testVector {
+  bool encrypt;
+  std::string count;
+  std::string key;
+  std::string plaintext;
+  std::string ciphertext;
+};
+
+// read every record from an AESAVS response file.
+// records are grouped under [ENCRYPT] and [DECRYPT] headers and each starts with a COUNT line
+std::vector<testVector> load_vectors(std::string path) {
+  std::vector<testVector> to_return;
+  std::ifstream file(path.c_str());
+  if (!file) {
+    std::cout << "could not open " << path << std::endl;
+    throw;
+  }
+  bool encrypt = true;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line[line.length() - 1] == '\r') {
+      line = line.substr(0, line.length() - 1);
+    }
+    if (line == "[ENCRYPT]") {
+      encrypt = true;
+      continue;
+    } else if (line == "[DECRYPT]") {
+      encrypt = false;
+      continue;
+    }
+    size_t separator = line.find(" = ");
+    if (line.empty() || line[0] == '#' || separator == std::string::npos) {
+      continue;
+    }
+    std::string name = line.substr(0, separator);
+    std::string value = line.substr(separator + 3);
+    for (unsigned int index = 0; index < value.length(); index++) {
+      value[index] = tolower(value[index]);
+    }
+    if (name == "COUNT") {
+      testVector record;
+      record.encrypt = encrypt;
+      record.count = value;
+      to_return.push_back(record);
+    } else if (to_return.empty()) {
+      continue;
+    } else if (name == "KEY") {
+      to_return.back().key = value;
+    } else if (name == "PLAINTEXT") {
+      to_return.back().plaintext = value;
+    } else if (name == "CIPHERTEXT") {
+      to_return.back().ciphertext = value;
+    }
+  }
+  return to_return;
+}
+
+// known answer test: a single encryption or decryption under the record's key
+void known_answer(testVector& record, std::string& expected_result, std::string& actual_result) {
+  state crypt_state(record.encrypt ? record.plaintext : record.ciphertext);
+  expected_result = record.encrypt ? record.ciphertext : record.plaintext;
+  actual_result = record.encrypt ? crypt_state.encrypt(record.key) : crypt_state.decrypt(record.key);
+}
+
+// monte carlo test: 1000 chained encryptions or decryptions under the record's key (AESAVS section 6.4.1)
+void monte_carlo(testVector& record, std::string& expected_result, std::string& actual_result) {
+  keyScheduler keys(record.key);
+  actual_result = record.encrypt ? record.plaintext : record.ciphertext;
+  for (unsigned int iteration = 0; iteration < 1000; iteration++) {
+    state crypt_state(actual_result);
+    actual_result = record.encrypt ? crypt_state.encrypt(keys) : crypt_state.decrypt(keys);
+    logger log;
+    log.clear_buffer();
+  }
+  expected_result = record.encrypt ? record.ciphertext : record.plaintext;
+}
+
+// run every record in an AESAVS response file. monte carlo files are recognised by "MCT" in the name
+void vector_file_test(std::string path) {
+  std::vector<testVector> records = load_vectors(path);
+  bool is_monte_carlo = path.find("MCT") != std::string::npos;
+  repeated_test(path, records.size(), [&](unsigned int index, std::string& expected_result, std::string& actual_result) {
+    if (is_monte_carlo) {
+      monte_carlo(records[index], expected_result, actual_result);
+    } else {
+      known_answer(records[index], expected_result, actual_result);
+    }
+  });
+}
+
+// reference encryption: the FIPS-197 section 5.1 step sequence driven directly on a bare state,
+// with the round count taken from the key length rather than from the key schedule
+std::string reference_encrypt(std::string block, std::string key) {
+  keyScheduler keys(key);
+  state crypt_state(block);
+  unsigned int total_rounds = key.length()*4/32 + 6;
+  crypt_state.addRoundKey(keys.get(0));
+  for (unsigned int round_index = 1; round_index < total_rounds; round_index++) {
+    crypt_state.subBytes();
+    crypt_state.shiftRows();
+    crypt_state.mixColumns();
+    crypt_state.addRoundKey(keys.get(round_index));
+  }
+  crypt_state.subBytes();
+  crypt_state.shiftRows();
+  crypt_state.addRoundKey(keys.get(total_rounds));
+  return crypt_state.to_string();
+}
+
+// reference decryption: the FIPS-197 section 5.3 inverse cipher step sequence
+std::string reference_decrypt(std::string block, std::string key) {
+  keyScheduler keys(key);
+  state crypt_state(block);
+  unsigned int total_rounds = key.length()*4/32 + 6;
+  crypt_state.addRoundKey(keys.get(total_rounds));
+  for (unsigned int round_index = total_rounds - 1; round_index > 0; round_index--) {
+    crypt_state.invShiftRows();
+    crypt_state.invSubBytes();
+    crypt_state.addRoundKey(keys.get(round_index));
+    crypt_state.invMixColumns();
+  }
+  crypt_state.invShiftRows();
+  crypt_state.invSubBytes();
+  crypt_state.addRoundKey(keys.get(0));
+  return crypt_state.to_string();
+}
+
+// generate a random 128, 192 or 256 bit key
+std::string random_key(std::mt19937& generator) {
+  std::uniform_int_distribution<int> distribution(2, 4);
+  return random_hex(generator, distribution(generator) * 64 / 4);
+}
+
 // this is a simple script to test the encrypt/decrypt process.
-int main() {
+// usage: aes-test [-n iterations] [-s seed] [-q] [AESAVS .rsp files...]
+// -q stops the debug log from being recorded, which speeds up long runs but leaves failures without a trace
+int main(int argc, char** argv) {
+  unsigned int iterations = 25;
+  unsigned int seed = 465;
+  bool record_log = true;
+  std::vector<std::string> vector_files;
+  for (signed int index = 1; index < argc; index++) {
+    std::string arg = std::string(argv[index]);
+    if (arg == "-n" && index + 1 < argc) {
+      iterations = atoi(argv[++index]);
+    } else if (arg == "-s" && index + 1 < argc) {
+      seed = atoi(argv[++index]);
+    } else if (arg == "-q") {
+      record_log = false;
+    } else {
+      vector_files.push_back(arg);
+    }
+  }
+
   logger::suppress_output = true;
-  logger::verbose = true;
+  logger::verbose = record_log;
   state crypt_state128("00112233445566778899aabbccddeeff");
   state crypt_state192("00112233445566778899aabbccddeeff");
   state crypt_state256("00112233445566778899aabbccddeeff");
@@ -30,4 +212,154 @@ int main() {
   single_test("128-bit key decryption", "00112233445566778899aabbccddeeff", crypt_state128.decrypt("000102030405060708090a0b0c0d0e0f"));
   single_test("192-bit key decryption", "00112233445566778899aabbccddeeff", crypt_state192.decrypt("000102030405060708090a0b0c0d0e0f1011121314151617"));
   single_test("256-bit key decryption", "00112233445566778899aabbccddeeff", crypt_state256.decrypt("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"));
+  keyWrapper wrapper128("000102030405060708090a0b0c0d0e0f");
+  keyWrapper wrapper256("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+  single_test("128-bit key wrap", "1fa68b0a8112b447aef34bd8fb5a7b829d3e862371d2cfe5", wrapper128.wrap("00112233445566778899aabbccddeeff"));
+  single_test("256-bit key wrap", "28c9f404c4b810f4cbccb35cfb87f8263f5786e2d80ed326cbc7f0e71a99f43bfb988b9b7a02dd21", wrapper256.wrap("00112233445566778899aabbccddeeff000102030405060708090a0b0c0d0e0f"));
+  single_test("128-bit key unwrap", "00112233445566778899aabbccddeeff", wrapper128.unwrap("1fa68b0a8112b447aef34bd8fb5a7b829d3e862371d2cfe5"));
+  single_test("256-bit key unwrap", "00112233445566778899aabbccddeeff000102030405060708090a0b0c0d0e0f", wrapper256.unwrap("28c9f404c4b810f4cbccb35cfb87f8263f5786e2d80ed326cbc7f0e71a99f43bfb988b9b7a02dd21"));
+  single_test("key unwrap integrity check", "", wrapper128.unwrap("1fa68b0a8112b447aef34bd8fb5a7b829d3e862371d2cfe4"));
+  reEncryptor rotator("000102030405060708090a0b0c0d0e0f", "000102030405060708090a0b0c0d0e0f1011121314151617");
+  single_test("128-bit to 192-bit key re-encryption", "dda97ca4864cdfe06eaf70a0ec0d7191", rotator.reencrypt("69c4e0d86a7b0430d8cdb78070b4c55a"));
+
+  // decrypt freshly constructed cypher text instead of reusing the encrypted states
+  state cypher_state128("69c4e0d86a7b0430d8cdb78070b4c55a");
+  state cypher_state192("dda97ca4864cdfe06eaf70a0ec0d7191");
+  state cypher_state256("8ea2b7ca516745bfeafc49904b496089");
+  single_test("128-bit key decryption of new state", "00112233445566778899aabbccddeeff", cypher_state128.decrypt("000102030405060708090a0b0c0d0e0f"));
+  single_test("192-bit key decryption of new state", "00112233445566778899aabbccddeeff", cypher_state192.decrypt("000102030405060708090a0b0c0d0e0f1011121314151617"));
+  single_test("256-bit key decryption of new state", "00112233445566778899aabbccddeeff", cypher_state256.decrypt("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"));
+
+  // a few records from the AESAVS ECB known answer and monte carlo files, so the harness runs without them
+  testVector builtin_vectors[] = {
+    { true, "GFSbox128", "00000000000000000000000000000000", "f34481ec3cc627bacd5dc3fb08f273e6", "0336763e966d92595a567cc9ce537f5e" },
+    { false, "GFSbox192", "000000000000000000000000000000000000000000000000", "1b077a6af4b7f98229de786d7516b639", "275cfc0413d8ccb70513c3859b1d0f72" },
+    { true, "GFSbox256", "0000000000000000000000000000000000000000000000000000000000000000", "014730f80ac625fe84f026c60bfd547d", "5c9d844ed46f9885085e5d6a4f94c7d7" },
+    { false, "VarKey128", "80000000000000000000000000000000", "00000000000000000000000000000000", "0edd33d3c621e546455bd8ba1418bec8" },
+    { true, "VarTxt128", "00000000000000000000000000000000", "80000000000000000000000000000000", "3ad78e726c1ec02b7ebfe92b23d9ec34" },
+    { true, "VarTxt192", "000000000000000000000000000000000000000000000000", "80000000000000000000000000000000", "6cd02513e8d4dc986b4afe087a60bd0c" },
+    { true, "VarTxt256", "0000000000000000000000000000000000000000000000000000000000000000", "80000000000000000000000000000000", "ddc6bf790c15760d8d9aeb6f9a75fd4e" }
+  };
+  for (unsigned int index = 0; index < sizeof(builtin_vectors)/sizeof(testVector); index++) {
+    std::string expected_result;
+    std::string actual_result;
+    known_answer(builtin_vectors[index], expected_result, actual_result);
+    single_test("AESAVS " + builtin_vectors[index].count + (builtin_vectors[index].encrypt ? " encryption" : " decryption"), expected_result, actual_result);
+  }
+  // MCT128 is the first AESAVS ECBMCT128 record, run in both directions.
+  // the 192 and 256 bit chains start from the FIPS-197 appendix C blocks and were checked against OpenSSL
+  testVector builtin_monte_carlo[] = {
+    { true, "MCT128", "139a35422f1d61de3c91787fe0507afd", "b9145a768b7dc489a096b546f43b231f", "d7c3ffac9031238650901e157364c386" },
+    { false, "MCT128", "139a35422f1d61de3c91787fe0507afd", "b9145a768b7dc489a096b546f43b231f", "d7c3ffac9031238650901e157364c386" },
+    { true, "chain192", "000102030405060708090a0b0c0d0e0f1011121314151617", "00112233445566778899aabbccddeeff", "d9d92fb5411433bd28973fc2fc543556" },
+    { false, "chain192", "000102030405060708090a0b0c0d0e0f1011121314151617", "05946f05bf4e21136b6b3bf098d3a126", "dda97ca4864cdfe06eaf70a0ec0d7191" },
+    { true, "chain256", "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "00112233445566778899aabbccddeeff", "fbe6e70f40a246e81b19eee74949123c" },
+    { false, "chain256", "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "dd3b73d3b02d275ed9b503d23385d3cf", "8ea2b7ca516745bfeafc49904b496089" }
+  };
+  for (unsigned int index = 0; index < sizeof(builtin_monte_carlo)/sizeof(testVector); index++) {
+    std::string expected_result;
+    std::string actual_result;
+    monte_carlo(builtin_monte_carlo[index], expected_result, actual_result);
+    single_test("monte carlo " + builtin_monte_carlo[index].count + (builtin_monte_carlo[index].encrypt ? " encryption" : " decryption"), expected_result, actual_result);
+  }
+
+  // full AESAVS response files passed on the command line
+  for (unsigned int index = 0; index < vector_files.size(); index++) {
+    vector_file_test(vector_files[index]);
+  }
+
+  // randomized differential tests against the reference state implementation
+  std::mt19937 generator(seed);
+  std::cout << "differential seed " << seed << std::endl;
+  repeated_test("encryption against the reference step sequence", iterations, [&](unsigned int, std::string& expected_result, std::string& actual_result) {
+    std::string key = random_key(generator);
+    std::string block = random_hex(generator, BLOCK_LENGTH/4);
+    keyScheduler keys(key);
+    state crypt_state(block);
+    expected_result = reference_encrypt(block, key);
+    actual_result = crypt_state.encrypt(keys);
+  });
+  repeated_test("decryption of random cypher text against the reference step sequence", iterations, [&](unsigned int, std::string& expected_result, std::string& actual_result) {
+    std::string key = random_key(generator);
+    std::string block = random_hex(generator, BLOCK_LENGTH/4);
+    keyScheduler keys(key);
+    state crypt_state(block);
+    expected_result = reference_decrypt(block, key);
+    actual_result = crypt_state.decrypt(keys);
+  });
+  repeated_test("batched re-encryption against the reference step sequence", iterations, [&](unsigned int, std::string& expected_result, std::string& actual_result) {
+    std::string old_key = random_key(generator);
+    std::string new_key = random_key(generator);
+    std::uniform_int_distribution<int> total_blocks(1, 3*BLOCKS_IN_FLIGHT);
+    std::string text_in = random_hex(generator, total_blocks(generator) * BLOCK_LENGTH/4);
+    for (unsigned int index = 0; index < text_in.length(); index += BLOCK_LENGTH/4) {
+      expected_result += reference_encrypt(reference_decrypt(text_in.substr(index, BLOCK_LENGTH/4), old_key), new_key);
+    }
+    reEncryptor rotator(old_key, new_key);
+    actual_result = rotator.reencrypt(text_in);
+  });
+  repeated_test("key wrap round trip and integrity check", iterations, [&](unsigned int, std::string& expected_result, std::string& actual_result) {
+    keyWrapper wrapper(random_key(generator));
+    std::uniform_int_distribution<int> total_semiblocks(2, 8);
+    expected_result = random_hex(generator, total_semiblocks(generator) * SEMIBLOCK_LENGTH/4);
+    std::string wrapped = wrapper.wrap(expected_result);
+    actual_result = wrapper.unwrap(wrapped);
+    // flipping any bit of the wrapped key must fail the integrity check
+    std::uniform_int_distribution<int> position(0, wrapped.length() - 1);
+    unsigned int flip = position(generator);
+    wrapped[flip] = half_byte_to_hex(hex_char_to_int(wrapped[flip]) ^ 1)[0];
+    if (wrapper.unwrap(wrapped) != "") {
+      actual_result = "tampered key unwrapped";
+    }
+  });
+
+  // batch mode: encrypt a directory of files on a small worker pool with a tiny memory budget
+  char batch_directory[] = "/tmp/aes-test-XXXXXX";
+  if (mkdtemp(batch_directory) == NULL) {
+    throw;
+  }
+  std::string directory = std::string(batch_directory);
+  std::vector<std::string> batch_texts;
+  for (unsigned int index = 0; index < 6; index++) {
+    std::uniform_int_distribution<int> total_blocks(1, 4);
+    batch_texts.push_back(random_hex(generator, total_blocks(generator) * BLOCK_LENGTH/4));
+    std::ofstream file((directory + "/" + half_byte_to_hex(index)).c_str());
+    file << batch_texts[index] << std::endl;
+  }
+  std::ofstream invalid_file((directory + "/invalid").c_str());
+  invalid_file << "0011" << std::endl;
+  invalid_file.close();
+  batchRunner runner("000102030405060708090a0b0c0d0e0f", true, 3, 64);
+  unsigned int parsed_count = 7;
+  bool accepted = parse_count("8", MAX_BATCH_WORKERS, parsed_count);
+  single_test("batch option accepts a positive count", "1 8", std::to_string(accepted) + " " + std::to_string(parsed_count));
+  const char* bad_counts[] = { "-1", "0", "abc", "4x", "", "1025", "99999999999999999999" };
+  std::string rejected;
+  for (unsigned int index = 0; index < sizeof(bad_counts)/sizeof(const char*); index++) {
+    rejected += std::to_string(parse_count(bad_counts[index], MAX_BATCH_WORKERS, parsed_count));
+  }
+  single_test("batch option rejects counts that aren't positive or are too large", "0000000 8", rejected + " " + std::to_string(parsed_count));
+  std::vector<std::string> batch_paths;
+  single_test("batch collects a directory", "1", std::to_string(runner.collect(directory, batch_paths)));
+  single_test("batch collects every file in a directory", "7", std::to_string(batch_paths.size()));
+  std::vector<std::string> missing_paths;
+  single_test("batch rejects a missing manifest", "0", std::to_string(runner.collect(directory + "/missing-manifest", missing_paths)));
+  std::vector<batchResult> batch_results = runner.run(batch_paths, false);
+  for (unsigned int index = 0; index < batch_texts.size(); index++) {
+    std::string expected_result;
+    for (unsigned int block = 0; block < batch_texts[index].length(); block += BLOCK_LENGTH/4) {
+      state crypt_state(batch_texts[index].substr(block, BLOCK_LENGTH/4));
+      expected_result += crypt_state.encrypt("000102030405060708090a0b0c0d0e0f");
+    }
+    std::ifstream output_file((batch_paths[index] + ".enc").c_str());
+    std::string actual_result;
+    std::getline(output_file, actual_result);
+    single_test("batch encryption of " + batch_paths[index], expected_result, actual_result);
+  }
+  single_test("batch rejects an invalid file", "text must be a multiple of 128 bits", batch_results[6].error);
+  for (unsigned int index = 0; index < batch_paths.size(); index++) {
+    remove(batch_paths[index].c_str());
+    remove((batch_paths[index] + ".enc").c_str());
+  }
+  rmdir(directory.c_str());
 }